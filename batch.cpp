@@ -0,0 +1,117 @@
+#include "batch.h"
+#include "recognizer.h"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <atomic>
+#include <iostream>
+
+Batch::Batch(Recognizer *recognizer, int threads, Format format)
+    : recognizer(recognizer)
+    , threads(qMax(1, threads))
+    , format(format)
+{
+}
+
+// Expands directories recursively and every page of multi-page images (TIFF)
+QList<Batch::Page> Batch::collectPages(const QStringList &inputs) const {
+    QStringList nameFilters;
+    for (const QByteArray &suffix : QImageReader::supportedImageFormats())
+        nameFilters << "*." + QString::fromLatin1(suffix);
+
+    QStringList files;
+    for (const QString &input : inputs) {
+        if (QFileInfo(input).isDir()) {
+            QStringList found;
+            QDirIterator it(input, nameFilters, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                found << it.next();
+            found.sort();
+            files << found;
+        } else {
+            files << input;
+        }
+    }
+
+    QList<Page> pages;
+    for (const QString &file : std::as_const(files)) {
+        QImageReader reader(file);
+        if (!reader.canRead()) {
+            std::cerr << "Skipping " << file.toStdString() << ": "
+                      << reader.errorString().toStdString() << std::endl;
+            continue;
+        }
+        // imageCount() is 0 for formats that cannot tell, those have one page
+        const int count = qMax(1, reader.imageCount());
+        for (int i = 0; i < count; ++i)
+            pages.append({file, i});
+    }
+    return pages;
+}
+
+int Batch::run(const QStringList &inputs) {
+    QList<Page> pages = collectPages(inputs);
+    if (pages.isEmpty()) {
+        std::cerr << "Error: No readable images given!" << std::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // One worker per engine, each worker holds one engine while recognizing
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+
+    QMutex outputMutex;
+    std::atomic<int> failed = 0;
+
+    QtConcurrent::blockingMap(&pool, pages, [&](const Page &page) {
+        QElapsedTimer pageTimer;
+        pageTimer.start();
+
+        QImageReader reader(page.path);
+        if (page.index > 0)
+            reader.jumpToImage(page.index);
+        const QImage image = reader.read();
+        if (image.isNull()) {
+            ++failed;
+            QMutexLocker locker(&outputMutex);
+            std::cerr << "Failed to read " << page.path.toStdString() << " page " << page.index + 1
+                      << ": " << reader.errorString().toStdString() << std::endl;
+            return;
+        }
+
+        const QString text = recognizer->recognize(image);
+        const qint64 elapsed = pageTimer.elapsed();
+
+        // Results are streamed in completion order
+        QMutexLocker locker(&outputMutex);
+        if (format == JsonLines) {
+            QJsonObject line;
+            line["file"] = page.path;
+            line["page"] = page.index + 1;
+            line["text"] = text;
+            line["ms"] = elapsed;
+            std::cout << QJsonDocument(line).toJson(QJsonDocument::Compact).constData() << std::endl;
+        } else {
+            std::cout << "==> " << page.path.toStdString() << " [page " << page.index + 1 << "] <==\n"
+                      << text.toStdString() << std::endl;
+        }
+    });
+
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    const int done = pages.size() - failed;
+    std::cerr << done << " page(s) in " << seconds << " s with " << threads << " thread(s), "
+              << done / seconds << " pages/s" << std::endl;
+
+    return failed ? 1 : 0;
+}
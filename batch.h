@@ -0,0 +1,31 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QStringList>
+
+class Recognizer;
+
+// Headless OCR of image files, directories and multi-page images
+class Batch
+{
+public:
+    enum Format { Text, JsonLines };
+
+    Batch(Recognizer *recognizer, int threads, Format format);
+
+    int run(const QStringList &inputs);
+
+private:
+    struct Page
+    {
+        QString path;
+        int index;
+    };
+
+    Recognizer *recognizer;
+    int threads;
+    Format format;
+
+    QList<Page> collectPages(const QStringList &inputs) const;
+};
+#endif // BATCH_H
@@ -0,0 +1,168 @@
+#include "enginepool.h"
+#include "recognizer.h"
+#include "trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+// Nearest-rank percentile of sorted durations, in milliseconds
+static double percentile(const QList<qint64> &sorted, double p) {
+    const int rank = qBound(0, int(std::ceil(p / 100.0 * sorted.size())) - 1, int(sorted.size()) - 1);
+    return sorted[rank] / 1e6;
+}
+
+// Stages in pipeline order, anything else is listed after them
+static const QStringList stageOrder = {
+    "toImage", "toGray", "cache", "preprocess", "layout", "Recognize", "GetUTF8Text", "total",
+};
+
+static void report(const QString &image, QHash<QString, QList<qint64>> stages, bool json) {
+    QStringList names = stages.keys();
+    std::sort(names.begin(), names.end(), [](const QString &a, const QString &b) {
+        const qsizetype ia = stageOrder.contains(a) ? stageOrder.indexOf(a) : stageOrder.size();
+        const qsizetype ib = stageOrder.contains(b) ? stageOrder.indexOf(b) : stageOrder.size();
+        return ia != ib ? ia < ib : a < b;
+    });
+
+    for (const QString &name : std::as_const(names)) {
+        QList<qint64> &durations = stages[name];
+        std::sort(durations.begin(), durations.end());
+
+        if (json) {
+            QJsonObject line;
+            line["image"] = image;
+            line["stage"] = name;
+            line["count"] = durations.size();
+            line["p50"] = percentile(durations, 50);
+            line["p90"] = percentile(durations, 90);
+            line["p99"] = percentile(durations, 99);
+            line["max"] = durations.last() / 1e6;
+            std::cout << QJsonDocument(line).toJson(QJsonDocument::Compact).constData() << std::endl;
+        } else {
+            std::printf("%-28s %-12s %5lld %10.2f %10.2f %10.2f %10.2f\n",
+                        qPrintable(image), qPrintable(name), qlonglong(durations.size()),
+                        percentile(durations, 50), percentile(durations, 90),
+                        percentile(durations, 99), durations.last() / 1e6);
+        }
+    }
+}
+
+// Recognizes every image whole and split into blocks, whitespace differences
+// are ignored since blocks are joined with their own line breaks
+static int compareSplit(Recognizer *recognizer, const QDir &corpus, const QStringList &files) {
+    int differences = 0;
+    for (const QString &file : files) {
+        const QImage image = QImage(corpus.filePath(file)).convertToFormat(QImage::Format_RGB32);
+        if (image.isNull()) {
+            std::cerr << "Skipping unreadable " << file.toStdString() << std::endl;
+            continue;
+        }
+
+        recognizer->setSplitArea(0);
+        const QString whole = recognizer->recognize(image).simplified();
+        // Any size qualifies, so even the small images are split when they have several blocks
+        recognizer->setSplitArea(1);
+        const QString split = recognizer->recognize(image).simplified();
+
+        qsizetype same = 0;
+        while (same < whole.size() && same < split.size() && whole[same] == split[same])
+            ++same;
+
+        if (whole == split) {
+            std::printf("%-28s same text, %lld characters\n", qPrintable(file), qlonglong(whole.size()));
+        } else {
+            ++differences;
+            std::printf("%-28s differs at character %lld: whole %lld, split %lld characters\n",
+                        qPrintable(file), qlonglong(same), qlonglong(whole.size()), qlonglong(split.size()));
+        }
+    }
+    return differences ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs the recognition path over a corpus of screenshots and reports per-stage percentiles in ms.");
+    parser.addHelpOption();
+    QCommandLineOption corpusOption("corpus", "Directory with the screenshots.", "dir", TEXTREC_CORPUS);
+    QCommandLineOption runsOption({"n", "runs"}, "Measured runs per image.", "count", "10");
+    QCommandLineOption langOption({"l", "lang"}, "Tesseract languages.", "languages", "eng");
+    QCommandLineOption enginesOption({"j", "engines"}, "Engines, more than one enables block splitting.", "count", "1");
+    QCommandLineOption preprocessOption("preprocess", "Preprocessing steps, as for textrec.", "steps", "crop,scale");
+    QCommandLineOption jsonOption("json", "Print JSON Lines instead of a table.");
+    QCommandLineOption checkSplitOption("check-split", "Compare the text of split and whole recognition instead of timing, exits 1 on a difference.");
+    parser.addOptions({corpusOption, runsOption, langOption, enginesOption, preprocessOption, jsonOption, checkSplitOption});
+    parser.process(a);
+
+    const bool json = parser.isSet(jsonOption);
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+
+    QDir corpus(parser.value(corpusOption));
+    const QStringList files = corpus.entryList({"*.png", "*.jpg", "*.tif", "*.tiff"}, QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        std::cerr << "Error: No images in " << corpus.path().toStdString() << std::endl;
+        return 1;
+    }
+
+    const bool checkSplit = parser.isSet(checkSplitOption);
+    trace::setCollecting(!checkSplit);
+
+    // Splitting is skipped with a single engine, so the check needs at least two
+    int engineCount = parser.value(enginesOption).toInt();
+    if (checkSplit)
+        engineCount = qMax(2, engineCount);
+
+    EnginePool engines(parser.value(langOption), engineCount);
+    if (!engines.init())
+        return 1;
+
+    // No cache, every run has to go through the whole pipeline
+    Recognizer recognizer(&engines);
+    recognizer.setPreprocessing(PreprocessOptions::fromString(parser.value(preprocessOption), PreprocessOptions().glyphHeight));
+
+    if (checkSplit)
+        return compareSplit(&recognizer, corpus, files);
+
+    if (!json)
+        std::printf("%-28s %-12s %5s %10s %10s %10s %10s\n", "image", "stage", "n", "p50", "p90", "p99", "max");
+    report("(startup)", trace::collected(), json);
+
+    for (const QString &file : files) {
+        const QImage source(corpus.filePath(file));
+        if (source.isNull()) {
+            std::cerr << "Skipping unreadable " << file.toStdString() << std::endl;
+            continue;
+        }
+
+        // Warm up so lazily loaded data is not part of the first run
+        recognizer.recognize(source.convertToFormat(QImage::Format_RGB32));
+        trace::collected();
+
+        for (int i = 0; i < runs; ++i) {
+            const qint64 start = trace::now();
+            QImage image;
+            {
+                // Stands in for QPixmap::toImage() of a screen grab
+                TraceScope stage("toImage");
+                image = source.convertToFormat(QImage::Format_RGB32);
+            }
+            recognizer.recognize(image);
+            trace::record("total", start, trace::now() - start);
+        }
+
+        report(file, trace::collected(), json);
+    }
+
+    return 0;
+}
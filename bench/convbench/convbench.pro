@@ -0,0 +1,24 @@
+# Checks imageconvert::toGray() against a scalar reference, then compares
+# the old per-pixel cv::Mat -> Pix loop with it
+
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = convbench
+
+SOURCES += \
+    main.cpp \
+    ../../imageconvert.cpp
+
+HEADERS += \
+    ../../imageconvert.h
+
+INCLUDEPATH += ../..
+INCLUDEPATH += /usr/include/leptonica
+INCLUDEPATH += /usr/include/opencv4
+
+LIBS += -llept
+LIBS += -lopencv_core \
+        -lopencv_imgproc
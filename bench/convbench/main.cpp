@@ -0,0 +1,134 @@
+#include "imageconvert.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRandomGenerator>
+
+#include <leptonica/allheaders.h>
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+// The conversion textrec::rec() used before imageconvert existed
+static Pix *oldConversion(const QImage &qImage) {
+    cv::Mat mat(qImage.height(), qImage.width(), CV_8UC4, const_cast<uchar*>(qImage.bits()), qImage.bytesPerLine());
+    // cvtColor reallocates the 3 channel result, the QImage itself is untouched
+    cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR);
+
+    Pix *image = pixCreate(mat.size().width, mat.size().height, 8);
+    for (int y = 0; y < mat.rows; ++y) {
+        for (int x = 0; x < mat.cols; ++x) {
+            cv::Vec3b color = mat.at<cv::Vec3b>(cv::Point(x, y));
+            int val = (color[0] + color[1] + color[2]) / 3;
+            pixSetPixel(image, x, y, val);
+        }
+    }
+    return image;
+}
+
+// Straight from the BT.601 weights in imageconvert.cpp, one pixel at a time
+static uchar referenceLuma(const uchar *bgra) {
+    return uchar((bgra[0] * 29 + bgra[1] * 150 + bgra[2] * 77 + 128) >> 8);
+}
+
+// Checks the vector path and its scalar tail against the reference on widths
+// that are not a multiple of 16, unaligned rows and padded strides. Returns
+// the number of mismatching pixels.
+static int verify() {
+    int mismatches = 0;
+    QRandomGenerator random(1);
+
+    for (int width = 1; width <= 67; ++width) {
+        // Start 0 to 3 bytes into the buffer so loads are not 16-byte aligned
+        for (int offset = 0; offset < 4; ++offset) {
+            std::vector<uchar> src(offset + width * 4);
+            for (uchar &byte : src)
+                byte = uchar(random.bounded(256));
+
+            // Bytes past the row must stay untouched
+            std::vector<uchar> dst(width + 16, 0xaa);
+            imageconvert::rowToGray(src.data() + offset, dst.data(), width);
+
+            for (int x = 0; x < width; ++x)
+                mismatches += dst[x] != referenceLuma(src.data() + offset + x * 4);
+            mismatches += int(std::count_if(dst.begin() + width, dst.end(), [](uchar byte) { return byte != 0xaa; }));
+        }
+    }
+
+    // Images over external buffers whose rows are padded past the pixels
+    for (int width : { 1, 15, 17, 33, 100 }) {
+        for (int padding : { 1, 3, 5 }) {
+            const int height = 7;
+            const int bytesPerLine = (width + padding) * 4;
+            std::vector<uchar> buffer(size_t(bytesPerLine) * height);
+            for (uchar &byte : buffer)
+                byte = uchar(random.bounded(256));
+
+            const QImage image(buffer.data(), width, height, bytesPerLine, QImage::Format_RGB32);
+            const GrayImage gray = imageconvert::toGray(image);
+            if (gray.width != width || gray.height != height) {
+                ++mismatches;
+                continue;
+            }
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x)
+                    mismatches += gray.bits()[size_t(y) * gray.stride + x] != referenceLuma(buffer.data() + size_t(y) * bytesPerLine + x * 4);
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+template <typename Function>
+static double medianMs(int runs, Function function) {
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        function();
+        times.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    // Timings of a wrong conversion are worthless
+    const int mismatches = verify();
+    if (mismatches) {
+        std::cerr << "Error: toGray differs from the scalar reference in " << mismatches << " pixels" << std::endl;
+        return 1;
+    }
+    std::cout << "toGray matches the scalar reference" << std::endl;
+
+    const QList<QSize> sizes = { QSize(640, 480), QSize(1920, 1080), QSize(3840, 2160) };
+    const int runs = 9;
+
+    for (const QSize &size : sizes) {
+        QImage image(size, QImage::Format_RGB32);
+        quint32 *pixels = reinterpret_cast<quint32 *>(image.bits());
+        QRandomGenerator::global()->fillRange(pixels, image.sizeInBytes() / sizeof(quint32));
+
+        const double before = medianMs(runs, [&image]() {
+            Pix *pix = oldConversion(image);
+            pixDestroy(&pix);
+        });
+        const double after = medianMs(runs, [&image]() {
+            GrayImage gray = imageconvert::toGray(image);
+            Q_UNUSED(gray);
+        });
+
+        std::cout << size.width() << "x" << size.height()
+                  << "  per-pixel loop: " << before << " ms"
+                  << "  toGray: " << after << " ms"
+                  << "  speedup: " << before / after << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "enginepool.h"
+#include "preprocess.h"
+#include "recognizer.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+
+#include <iostream>
+#include <vector>
+
+// Levenshtein distance between the recognized and the expected text
+static int editDistance(const QString &a, const QString &b) {
+    std::vector<int> row(b.size() + 1);
+    for (int j = 0; j <= b.size(); ++j)
+        row[j] = j;
+
+    for (int i = 1; i <= a.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            const int above = row[j];
+            row[j] = qMin(qMin(row[j] + 1, row[j - 1] + 1), diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+// Whitespace differences do not count as recognition errors
+static QString normalized(const QString &text) {
+    return text.simplified();
+}
+
+struct Sample
+{
+    QString name;
+    QImage image;
+    QString truth;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares recognition time and character error rate with and without preprocessing. "
+                                     "Every image in the corpus needs a <name>.gt.txt file next to it.");
+    parser.addHelpOption();
+    QCommandLineOption langOption({"l", "lang"}, "Tesseract languages.", "languages", "eng");
+    QCommandLineOption stepsOption("preprocess", "Steps to compare against none.", "steps", "crop,scale");
+    QCommandLineOption glyphHeightOption("glyph-height", "Median glyph height the scale step normalizes to.", "pixels", "22");
+    parser.addOptions({langOption, stepsOption, glyphHeightOption});
+    parser.addPositionalArgument("corpus", "Directory with images and their .gt.txt transcriptions.");
+    parser.process(a);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QList<Sample> samples;
+    QDir corpus(parser.positionalArguments().first());
+    for (const QString &file : corpus.entryList({"*.png", "*.jpg", "*.tif", "*.tiff"}, QDir::Files, QDir::Name)) {
+        QFile truth(corpus.filePath(QFileInfo(file).completeBaseName() + ".gt.txt"));
+        if (!truth.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+        samples.append({file, QImage(corpus.filePath(file)), normalized(QString::fromUtf8(truth.readAll()))});
+    }
+    if (samples.isEmpty()) {
+        std::cerr << "Error: No images with .gt.txt transcriptions in the corpus!" << std::endl;
+        return 1;
+    }
+
+    // One engine and no splitting so only the preprocessing differs
+    EnginePool engines(parser.value(langOption), 1);
+    if (!engines.init())
+        return 1;
+
+    const QList<PreprocessOptions> configurations = {
+        PreprocessOptions::fromString("none", 0),
+        PreprocessOptions::fromString(parser.value(stepsOption), parser.value(glyphHeightOption).toInt()),
+    };
+
+    for (const PreprocessOptions &options : configurations) {
+        Recognizer recognizer(&engines);
+        recognizer.setSplitArea(0);
+        recognizer.setPreprocessing(options);
+
+        // Warm up so the first sample does not pay for lazily loaded data
+        recognizer.recognize(samples.first().image);
+
+        qint64 totalNs = 0;
+        qint64 errors = 0;
+        qint64 characters = 0;
+        for (const Sample &sample : std::as_const(samples)) {
+            QElapsedTimer timer;
+            timer.start();
+            const QString text = normalized(recognizer.recognize(sample.image));
+            totalNs += timer.nsecsElapsed();
+
+            errors += editDistance(text, sample.truth);
+            characters += sample.truth.size();
+        }
+
+        std::cout << options.toString().toStdString() << ": " << samples.size() << " images, "
+                  << totalNs / 1e6 << " ms total, " << totalNs / 1e6 / samples.size() << " ms/image, CER "
+                  << 100.0 * errors / qMax<qint64>(1, characters) << "%" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+# Recognizes a corpus with and without preprocessing and compares time and accuracy
+
+QT       += core gui concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = preprocbench
+
+SOURCES += \
+    main.cpp \
+    ../../enginepool.cpp \
+    ../../imageconvert.cpp \
+    ../../preprocess.cpp \
+    ../../recognizer.cpp \
+    ../../resultcache.cpp \
+    ../../timing.cpp \
+    ../../trace.cpp
+
+HEADERS += \
+    ../../enginepool.h \
+    ../../imageconvert.h \
+    ../../preprocess.h \
+    ../../recognizer.h \
+    ../../resultcache.h \
+    ../../timing.h \
+    ../../trace.h
+
+INCLUDEPATH += ../..
+INCLUDEPATH += /usr/include/tesseract
+INCLUDEPATH += /usr/include/leptonica
+INCLUDEPATH += /usr/include/opencv4
+
+LIBS += -ltesseract
+LIBS += -llept
+LIBS += -lopencv_core \
+        -lopencv_imgproc
@@ -0,0 +1,43 @@
+# Benchmark of the recognition path over bench/corpus, reports per-stage
+# percentiles. Build it in its own directory: qmake benchmark.pro && make
+
+QT       += core gui concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = textrec_bench
+
+# Keeps in-source builds from overwriting the application's Makefile
+MAKEFILE = Makefile.benchmark
+
+DEFINES += TEXTREC_CORPUS=\\\"$$PWD/bench/corpus\\\"
+
+SOURCES += \
+    bench/benchmark.cpp \
+    enginepool.cpp \
+    imageconvert.cpp \
+    preprocess.cpp \
+    recognizer.cpp \
+    resultcache.cpp \
+    timing.cpp \
+    trace.cpp
+
+HEADERS += \
+    enginepool.h \
+    imageconvert.h \
+    preprocess.h \
+    recognizer.h \
+    resultcache.h \
+    timing.h \
+    trace.h
+
+INCLUDEPATH += $$PWD
+INCLUDEPATH += /usr/include/tesseract
+INCLUDEPATH += /usr/include/leptonica
+INCLUDEPATH += /usr/include/opencv4
+
+LIBS += -ltesseract
+LIBS += -llept
+LIBS += -lopencv_core \
+        -lopencv_imgproc
@@ -0,0 +1,92 @@
+#include "daemon.h"
+#include "textrec.h"
+
+#include <QLocalSocket>
+
+#include <iostream>
+
+static const char *serverName = "textrec";
+
+Daemon::Daemon(textrec *overlay, QObject *parent)
+    : QObject(parent)
+    , overlay(overlay)
+{
+    connect(&server, &QLocalServer::newConnection, this, &Daemon::handleConnection);
+    connect(overlay, &textrec::captureFinished, this, &Daemon::reply);
+}
+
+bool Daemon::listen() {
+    // A daemon that still answers keeps its socket
+    QLocalSocket probe;
+    probe.connectToServer(serverName);
+    if (probe.waitForConnected(500)) {
+        std::cerr << "Another textrec daemon is already running" << std::endl;
+        return false;
+    }
+
+    // Nobody answered, so the socket was left behind by a crashed daemon
+    QLocalServer::removeServer(serverName);
+
+    if (!server.listen(serverName)) {
+        std::cerr << "Failed to listen on " << serverName << ": "
+                  << server.errorString().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Daemon::handleConnection() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            while (socket->canReadLine()) {
+                const QByteArray command = socket->readLine().trimmed();
+                if (command != "capture")
+                    continue;
+
+                // One capture at a time, a second client gets an empty reply
+                // instead of waiting on a selection that is not its own
+                if (overlay->isVisible()) {
+                    socket->disconnectFromServer();
+                    return;
+                }
+
+                reply(QString());
+                requester = socket;
+                overlay->capture();
+            }
+        });
+    }
+}
+
+void Daemon::reply(const QString &text) {
+    if (!requester)
+        return;
+
+    requester->write(text.toUtf8());
+    requester->disconnectFromServer();
+    requester = nullptr;
+}
+
+// Asks a running daemon to start a capture, returns false if none is running.
+// With text set it waits until the selection is done and returns its text.
+bool Daemon::trigger(QString *text) {
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(500))
+        return false;
+
+    socket.write("capture\n");
+    socket.waitForBytesWritten(500);
+
+    if (text) {
+        QByteArray reply;
+        while (socket.waitForReadyRead(-1))
+            reply += socket.readAll();
+        reply += socket.readAll();
+        *text = QString::fromUtf8(reply);
+    }
+
+    socket.disconnectFromServer();
+    return true;
+}
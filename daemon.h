@@ -0,0 +1,34 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+
+class textrec;
+
+// Listens on a local socket and opens the resident overlay when a client asks
+// for a capture
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    Daemon(textrec *overlay, QObject *parent = nullptr);
+
+    bool listen();
+
+    static bool trigger(QString *text = nullptr);
+
+private:
+    textrec *overlay;
+    QLocalServer server;
+
+    // Client that asked for the running capture, it gets the text back
+    QPointer<QLocalSocket> requester;
+
+    void handleConnection();
+    void reply(const QString &text);
+};
+#endif // DAEMON_H
@@ -0,0 +1,60 @@
+#include "enginepool.h"
+#include "timing.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+
+#include <iostream>
+
+EnginePool::EnginePool(const QString &languages, int size)
+    : langs(languages)
+    , count(qMax(1, size))
+{
+}
+
+EnginePool::~EnginePool()
+{
+    for (tesseract::TessBaseAPI *engine : engines) {
+        engine->End();
+        delete engine;
+    }
+}
+
+// Loads the traineddata into every engine, engines are initialized in parallel
+bool EnginePool::init() {
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < count; ++i)
+        engines.append(new tesseract::TessBaseAPI());
+
+    const QByteArray lang = langs.toUtf8();
+    QList<int> results = QtConcurrent::blockingMapped(engines, [&lang](tesseract::TessBaseAPI *engine) {
+        TraceScope stage("Init");
+        return engine->Init(nullptr, lang.constData());
+    });
+
+    if (results.contains(-1)) {
+        std::cerr << "Error: Could not initialize tesseract with language " << lang.constData() << std::endl;
+        return false;
+    }
+
+    idle = engines;
+    qCInfo(lcTiming) << "cold start:" << count << "engine(s) for" << langs << "ready in" << timer.elapsed() << "ms";
+    return true;
+}
+
+// Blocks until an engine is free
+tesseract::TessBaseAPI *EnginePool::acquire() {
+    QMutexLocker locker(&mutex);
+    while (idle.isEmpty())
+        available.wait(&mutex);
+    return idle.takeLast();
+}
+
+void EnginePool::release(tesseract::TessBaseAPI *engine) {
+    QMutexLocker locker(&mutex);
+    idle.append(engine);
+    available.wakeOne();
+}
@@ -0,0 +1,55 @@
+#ifndef ENGINEPOOL_H
+#define ENGINEPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include <tesseract/baseapi.h>
+
+// Keeps a fixed number of initialized tesseract engines so the traineddata
+// is loaded once instead of on every capture
+class EnginePool
+{
+public:
+    EnginePool(const QString &languages, int size);
+    ~EnginePool();
+
+    bool init();
+
+    tesseract::TessBaseAPI *acquire();
+    void release(tesseract::TessBaseAPI *engine);
+
+    QString languages() const { return langs; }
+    int size() const { return engines.size(); }
+
+private:
+    QString langs;
+    int count;
+
+    QList<tesseract::TessBaseAPI *> engines;
+    QList<tesseract::TessBaseAPI *> idle;
+    QMutex mutex;
+    QWaitCondition available;
+};
+
+// Borrows an engine for the lifetime of the scope
+class EngineLease
+{
+public:
+    explicit EngineLease(EnginePool *pool) : pool(pool), engine(pool->acquire()) {}
+    ~EngineLease() { engine->Clear(); pool->release(engine); }
+
+    EngineLease(const EngineLease &) = delete;
+    EngineLease &operator=(const EngineLease &) = delete;
+
+    tesseract::TessBaseAPI *operator->() const { return engine; }
+    tesseract::TessBaseAPI *get() const { return engine; }
+
+private:
+    EnginePool *pool;
+    tesseract::TessBaseAPI *engine;
+};
+
+#endif // ENGINEPOOL_H
@@ -0,0 +1,84 @@
+#include "imageconvert.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace imageconvert {
+
+// BT.601 luma weights in 8.8 fixed point, they add up to 256
+static const int weightR = 77;
+static const int weightG = 150;
+static const int weightB = 29;
+
+#ifdef __SSE2__
+// Luma of 4 BGRA pixels, one result in the low byte of each 32-bit lane.
+// Every product fits in 16 bits so the 16-bit multiply never spills into the
+// upper half of a lane.
+static inline __m128i lumaOf4(__m128i pixels) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i b = _mm_and_si128(pixels, mask);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+    const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+
+    __m128i sum = _mm_mullo_epi16(b, _mm_set1_epi32(weightB));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(g, _mm_set1_epi32(weightG)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(r, _mm_set1_epi32(weightR)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi32(128));
+    return _mm_srli_epi32(sum, 8);
+}
+#endif
+
+void rowToGray(const uchar *src, uchar *dst, int width) {
+    int x = 0;
+
+#ifdef __SSE2__
+    // 16 pixels per iteration
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *in = reinterpret_cast<const __m128i *>(src + x * 4);
+        const __m128i y0 = lumaOf4(_mm_loadu_si128(in));
+        const __m128i y1 = lumaOf4(_mm_loadu_si128(in + 1));
+        const __m128i y2 = lumaOf4(_mm_loadu_si128(in + 2));
+        const __m128i y3 = lumaOf4(_mm_loadu_si128(in + 3));
+
+        const __m128i lo = _mm_packs_epi32(y0, y1);
+        const __m128i hi = _mm_packs_epi32(y2, y3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; x < width; ++x) {
+        const uchar *p = src + x * 4;
+        dst[x] = uchar((p[0] * weightB + p[1] * weightG + p[2] * weightR + 128) >> 8);
+    }
+}
+
+GrayImage toGray(const QImage &image) {
+    GrayImage gray;
+    if (image.isNull())
+        return gray;
+
+    QImage source = image;
+    switch (source.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+    default:
+        source = source.convertToFormat(QImage::Format_RGB32);
+        break;
+    }
+
+    gray.width = source.width();
+    gray.height = source.height();
+    gray.stride = gray.width;
+    gray.data.resize(size_t(gray.stride) * gray.height);
+
+    // constScanLine() avoids detaching the pixmap's image
+    for (int y = 0; y < gray.height; ++y)
+        rowToGray(source.constScanLine(y), gray.data.data() + size_t(y) * gray.stride, gray.width);
+
+    return gray;
+}
+
+}
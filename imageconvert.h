@@ -0,0 +1,32 @@
+#ifndef IMAGECONVERT_H
+#define IMAGECONVERT_H
+
+#include <QImage>
+
+#include <vector>
+
+// Tightly packed 8-bit grayscale buffer that can be handed to
+// TessBaseAPI::SetImage(const unsigned char*, ...) as is
+struct GrayImage
+{
+    std::vector<uchar> data;
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+
+    bool isNull() const { return data.empty(); }
+    const uchar *bits() const { return data.data(); }
+};
+
+namespace imageconvert {
+
+// Converts a QImage straight from its 32-bit buffer to luma in a single pass,
+// other formats are converted to Format_RGB32 first
+GrayImage toGray(const QImage &image);
+
+// Converts one BGRA row (QImage::Format_RGB32 byte order) of width pixels
+void rowToGray(const uchar *src, uchar *dst, int width);
+
+}
+
+#endif // IMAGECONVERT_H
@@ -1,11 +1,215 @@
 #include "textrec.h"
+#include "batch.h"
+#include "daemon.h"
+#include "timing.h"
+#include "trace.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <iostream>
+
+#include <signal.h>
+#include <unistd.h>
+
+// A selection rarely has more text blocks than this, more engines only cost memory
+static const int maxSplitEngines = 4;
+
+// How often a daemon writes the result cache while it changes
+static const int cacheSaveInterval = 30 * 1000;
+
+// A signal handler may only write to a pipe, the event loop does the rest
+static int signalPipe[2];
+
+static void onTerminate(int) {
+    const char byte = 1;
+    const ssize_t written = ::write(signalPipe[1], &byte, 1);
+    Q_UNUSED(written);
+}
+
+// Turns SIGTERM and SIGINT into a normal quit, so aboutToQuit handlers run
+static void quitOnTerminate(QCoreApplication *app) {
+    if (::pipe(signalPipe) != 0)
+        return;
+
+    QSocketNotifier *notifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, &QCoreApplication::quit);
+
+    struct sigaction action = {};
+    action.sa_handler = onTerminate;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+}
+
+static bool hasArgument(int argc, char *argv[], const char *name) {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Batch runs must not need a display, so check before creating the application
+static bool isHeadless(int argc, char *argv[]) {
+    return hasArgument(argc, argv, "--batch") || hasArgument(argc, argv, "--cache-stats");
+}
+
+// Hands the capture to a running daemon without connecting to the display,
+// returns false if there is none so the caller can run once instead
+static bool triggerDaemon(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QString text;
+    const bool print = hasArgument(argc, argv, "--print");
+    if (!Daemon::trigger(print ? &text : nullptr))
+        return false;
+
+    if (print && !text.isEmpty())
+        std::cout << text.toStdString() << std::endl;
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    textrec w;
-    w.show();
-    return a.exec();
+    QElapsedTimer startup;
+    startup.start();
+
+    if (hasArgument(argc, argv, "--trigger") && !hasArgument(argc, argv, "--help") && triggerDaemon(argc, argv))
+        return 0;
+
+    const bool headless = isHeadless(argc, argv);
+    QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+    QCoreApplication::setApplicationName("textrec");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Select an area of the screen to copy its text");
+    parser.addHelpOption();
+    QCommandLineOption daemonOption("daemon", "Stay resident with warm engines and wait for capture requests.");
+    QCommandLineOption triggerOption("trigger", "Ask the running daemon to start a capture, run once if there is none.");
+    QCommandLineOption printOption("print", "With --trigger, wait for the selection and print its text.");
+    QCommandLineOption outputOption("output", "Where recognized text goes: any of clipboard, notify and stdout.", "sinks", "clipboard,notify");
+    QCommandLineOption holdClipboardOption("hold-clipboard", "Keep the text in file on the clipboard until another application takes it.", "file");
+    holdClipboardOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    QCommandLineOption batchOption("batch", "Recognize the given files and directories without opening the overlay.");
+    QCommandLineOption jsonOption("json", "Print batch results as JSON Lines.");
+    QCommandLineOption splitOption("split", "Split large images into text blocks and recognize them concurrently (default outside --batch).");
+    QCommandLineOption noSplitOption("no-split", "Recognize the whole selection with a single engine.");
+    QCommandLineOption cacheOption("cache", "Reuse results for pixels seen before: exact, perceptual or off.", "mode", "exact");
+    QCommandLineOption cacheSizeOption("cache-size", "Number of results kept in the cache.", "entries", "1000");
+    QCommandLineOption cacheStatsOption("cache-stats", "Print cache statistics and exit.");
+    QCommandLineOption preprocessOption("preprocess", "Steps run before recognition: any of crop, binarize and scale, or none.", "steps", "crop,scale");
+    QCommandLineOption glyphHeightOption("glyph-height", "Median glyph height in pixels the scale step normalizes to.", "pixels", "22");
+    QCommandLineOption traceOption("trace", "Write per-stage timings to file in Chrome trace format (also TEXTREC_TRACE).", "file");
+    QCommandLineOption langOption({"l", "lang"}, "Tesseract languages, e.g. eng+deu.", "languages", "eng");
+    QCommandLineOption enginesOption({"j", "engines"}, "Number of engines to keep loaded, default one per core for --batch, one with --no-split and otherwise one per core up to 4.", "count");
+    parser.addOptions({daemonOption, triggerOption, printOption, outputOption, holdClipboardOption, batchOption, jsonOption, splitOption, noSplitOption, cacheOption, cacheSizeOption, cacheStatsOption, preprocessOption, glyphHeightOption, traceOption, langOption, enginesOption});
+    parser.addPositionalArgument("inputs", "Images, multi-page TIFFs or directories for --batch.", "[inputs...]");
+    parser.process(*app);
+
+    // Background helper started by a one-shot run, it needs no engines
+    if (parser.isSet(holdClipboardOption))
+        return ClipboardSink::hold(parser.value(holdClipboardOption));
+
+    const bool batch = parser.isSet(batchOption);
+
+    const QString tracePath = parser.isSet(traceOption) ? parser.value(traceOption) : qEnvironmentVariable("TEXTREC_TRACE");
+    if (!tracePath.isEmpty() && !trace::open(tracePath))
+        std::cerr << "Failed to open trace file " << tracePath.toStdString() << std::endl;
+
+    QScopedPointer<ResultCache> cache;
+    const QString cacheMode = parser.value(cacheOption);
+    if (cacheMode != "off") {
+        cache.reset(new ResultCache(ResultCache::defaultPath(), parser.value(cacheSizeOption).toInt(),
+                                    cacheMode == "perceptual" ? ResultCache::Perceptual : ResultCache::Exact));
+        cache->load();
+    }
+
+    if (parser.isSet(cacheStatsOption)) {
+        std::cout << (cache ? cache->stats().toStdString() : "cache is off") << std::endl;
+        return 0;
+    }
+
+    // Splitting only pays off with several engines, batch runs use one per page instead
+    const bool split = !parser.isSet(noSplitOption) && (!batch || parser.isSet(splitOption));
+    int engineCount = 1;
+    if (parser.isSet(enginesOption))
+        engineCount = parser.value(enginesOption).toInt();
+    else if (batch)
+        engineCount = QThread::idealThreadCount();
+    else if (split)
+        engineCount = qBound(1, QThread::idealThreadCount(), maxSplitEngines);
+
+    EnginePool engines(parser.value(langOption), engineCount);
+    if (!engines.init())
+        return 1;
+
+    Recognizer recognizer(&engines);
+
+    if (!split)
+        recognizer.setSplitArea(0);
+    recognizer.setCache(cache.get());
+    recognizer.setPreprocessing(PreprocessOptions::fromString(parser.value(preprocessOption),
+                                                              parser.value(glyphHeightOption).toInt()));
+
+    if (batch) {
+        Batch runner(&recognizer, engines.size(), parser.isSet(jsonOption) ? Batch::JsonLines : Batch::Text);
+        const int status = runner.run(parser.positionalArguments());
+        if (cache)
+            std::cerr << "cache: " << cache->stats().toStdString() << std::endl;
+        return status;
+    }
+
+    QFile standardOutput;
+    standardOutput.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+
+    textrec w(&recognizer);
+
+    const QStringList sinks = parser.value(outputOption).split(',', Qt::SkipEmptyParts);
+    const bool resident = parser.isSet(daemonOption);
+    if (sinks.contains("clipboard"))
+        w.addSink(new ClipboardSink(!resident));
+    if (sinks.contains("notify"))
+        w.addSink(new NotificationSink());
+    if (sinks.contains("stdout"))
+        w.addSink(new DeviceSink(&standardOutput, "stdout"));
+
+    // The overlay is only hidden between captures, the modes below decide when to quit
+    QApplication::setQuitOnLastWindowClosed(false);
+
+    if (resident) {
+        Daemon daemon(&w);
+        if (!daemon.listen())
+            return 1;
+
+        // The store is written off the GUI thread while it changes, so no
+        // capture waits for the disk, and once more when the daemon stops
+        QTimer saveTimer;
+        if (cache) {
+            ResultCache *store = cache.get();
+            QObject::connect(&saveTimer, &QTimer::timeout, [store]() {
+                QThreadPool::globalInstance()->start([store]() { store->save(); });
+            });
+            saveTimer.start(cacheSaveInterval);
+            QObject::connect(app.data(), &QCoreApplication::aboutToQuit, [store]() { store->save(); });
+        }
+        quitOnTerminate(app.data());
+
+        qCInfo(lcTiming) << "daemon ready in" << startup.elapsed() << "ms";
+        return app->exec();
+    }
+
+    // The clipboard is held by a detached helper, so a one-shot run is done
+    // as soon as the text is delivered
+    QObject::connect(&w, &textrec::captureFinished, app.data(), &QCoreApplication::quit);
+
+    w.capture();
+    qCInfo(lcTiming) << "overlay shown in" << startup.elapsed() << "ms";
+    return app->exec();
 }
@@ -0,0 +1,110 @@
+#include "outputsink.h"
+#include "timing.h"
+
+#include <QClipboard>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QProcess>
+#include <QTemporaryFile>
+
+void ClipboardSink::setText(const QString &text) {
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setText(text, QClipboard::Clipboard);
+    if (clipboard->supportsSelection())
+        clipboard->setText(text, QClipboard::Selection);
+}
+
+void ClipboardSink::deliver(const QString &text) {
+    if (!detached) {
+        setText(text);
+        return;
+    }
+
+    // Only readable by the user, the helper removes it once it has read it
+    QTemporaryFile file(QDir::tempPath() + "/textrec-XXXXXX");
+    file.setAutoRemove(false);
+    if (!file.open() || file.write(text.toUtf8()) < 0) {
+        qWarning() << "Failed to hand the text to the clipboard helper:" << file.errorString();
+        setText(text);
+        return;
+    }
+    file.close();
+
+    // The helper must not hold on to our stdout, or $(textrec ...) would never return
+    QProcess helper;
+    helper.setProgram(QCoreApplication::applicationFilePath());
+    helper.setArguments({"--hold-clipboard", file.fileName()});
+    helper.setStandardInputFile(QProcess::nullDevice());
+    helper.setStandardOutputFile(QProcess::nullDevice());
+    helper.setStandardErrorFile(QProcess::nullDevice());
+    if (!helper.startDetached()) {
+        file.remove();
+        setText(text);
+    }
+}
+
+int ClipboardSink::hold(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return 1;
+    const QString text = QString::fromUtf8(file.readAll());
+    file.remove();
+
+    setText(text);
+
+    // Quit as soon as another application owns the clipboard
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    QObject::connect(clipboard, &QClipboard::dataChanged, clipboard, [clipboard]() {
+        if (!clipboard->ownsClipboard())
+            QCoreApplication::quit();
+    });
+    return QCoreApplication::exec();
+}
+
+// The message must reach the bus before a one-shot run exits
+NotificationSink::~NotificationSink()
+{
+    if (pending)
+        pending->waitForFinished();
+}
+
+void NotificationSink::deliver(const QString &text) {
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.Notifications",
+                                                          "/org/freedesktop/Notifications",
+                                                          "org.freedesktop.Notifications",
+                                                          "Notify");
+    // Replacing the previous notification keeps repeated captures from piling up.
+    // Servers may read the body as markup, so < > & in code or terminal text are escaped.
+    message << QString("textrec") << lastId << QString("edit-copy")
+            << QString("The recognized text copied to clipboard") << text.toHtmlEscaped()
+            << QStringList() << QVariantMap() << 5000;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pending = QDBusConnection::sessionBus().asyncCall(message);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(*pending);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [this, timer](QDBusPendingCallWatcher *call) {
+        QDBusPendingReply<uint> reply = *call;
+        if (reply.isError())
+            qWarning() << "Failed to send notification:" << reply.error().message();
+        else
+            lastId = reply.value();
+        qCInfo(lcTiming) << "notify: shown after" << timer.elapsed() << "ms";
+        call->deleteLater();
+    });
+}
+
+void DeviceSink::deliver(const QString &text) {
+    if (!device || !device->isWritable())
+        return;
+    device->write(text.toUtf8());
+    if (!text.endsWith('\n'))
+        device->write("\n");
+}
@@ -0,0 +1,71 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <QDBusPendingCall>
+#include <QIODevice>
+#include <QPointer>
+#include <QString>
+
+#include <optional>
+
+// Destination for recognized text. Sinks run in-process and must not block
+// on other programs, anything slow is handed off asynchronously.
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    virtual const char *name() const = 0;
+    virtual void deliver(const QString &text) = 0;
+};
+
+// Owns the clipboard (and the X11 primary selection) until another
+// application takes it
+class ClipboardSink : public OutputSink
+{
+public:
+    // A detached sink hands the text to a background textrec --hold-clipboard
+    // process, so a one-shot run can exit right away like xclip does
+    explicit ClipboardSink(bool detached = false) : detached(detached) {}
+
+    const char *name() const override { return "clipboard"; }
+    void deliver(const QString &text) override;
+
+    // Body of the background process, takes the text from path and removes it
+    static int hold(const QString &path);
+
+private:
+    bool detached;
+
+    static void setText(const QString &text);
+};
+
+// org.freedesktop.Notifications over the session bus, the reply is not waited for
+class NotificationSink : public OutputSink
+{
+public:
+    ~NotificationSink();
+
+    const char *name() const override { return "notify"; }
+    void deliver(const QString &text) override;
+
+private:
+    uint lastId = 0;
+    std::optional<QDBusPendingCall> pending;
+};
+
+// Writes the text to stdout or a socket, followed by a newline
+class DeviceSink : public OutputSink
+{
+public:
+    DeviceSink(QIODevice *device, const char *name) : device(device), sinkName(name) {}
+
+    const char *name() const override { return sinkName; }
+    void deliver(const QString &text) override;
+
+private:
+    QPointer<QIODevice> device;
+    const char *sinkName;
+};
+
+#endif // OUTPUTSINK_H
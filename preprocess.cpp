@@ -0,0 +1,167 @@
+#include "preprocess.h"
+#include "timing.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// The median connected component of 10pt text scanned at 300 dpi is about
+// 22 pixels high, mostly lowercase letters with some ascenders among them
+static const int referenceDpi = 300;
+static const int referenceGlyphHeight = 22;
+
+// Upscaling stops at this many output pixels, selections already larger are
+// never enlarged
+static const double maxScaledPixels = 4e6;
+
+PreprocessOptions PreprocessOptions::fromString(const QString &steps, int glyphHeight) {
+    const QStringList names = steps.split(',', Qt::SkipEmptyParts);
+
+    PreprocessOptions options;
+    options.crop = names.contains("crop");
+    options.binarize = names.contains("binarize");
+    options.glyphHeight = names.contains("scale") ? glyphHeight : 0;
+    return options;
+}
+
+QString PreprocessOptions::toString() const {
+    QStringList names;
+    if (crop)
+        names << "crop";
+    if (binarize)
+        names << "binarize";
+    if (glyphHeight > 0)
+        names << QString("scale=%1").arg(glyphHeight);
+    return names.isEmpty() ? QString("none") : names.join(',');
+}
+
+namespace preprocess {
+
+static cv::Mat wrap(const GrayImage &gray) {
+    return cv::Mat(gray.height, gray.width, CV_8UC1, const_cast<uchar *>(gray.bits()), gray.stride);
+}
+
+static GrayImage unwrap(const cv::Mat &mat) {
+    GrayImage gray;
+    gray.width = mat.cols;
+    gray.height = mat.rows;
+    gray.stride = mat.cols;
+    gray.data.resize(size_t(gray.stride) * gray.height);
+    for (int y = 0; y < mat.rows; ++y)
+        std::copy_n(mat.ptr<uchar>(y), mat.cols, gray.data.data() + size_t(y) * gray.stride);
+    return gray;
+}
+
+// Otsu mask with the text set, whichever polarity the selection has. The
+// background is taken to be the larger of the two classes.
+static cv::Mat foregroundMask(const cv::Mat &gray, bool *darkText) {
+    cv::Mat mask;
+    cv::threshold(gray, mask, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    *darkText = size_t(cv::countNonZero(mask)) * 2 < mask.total();
+    if (!*darkText)
+        cv::bitwise_not(mask, mask);
+    return mask;
+}
+
+// Median height of the glyph sized connected components, 0 if there are none
+static int medianGlyphHeight(const cv::Mat &mask) {
+    cv::Mat labels, stats, centroids;
+    const int count = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8);
+
+    std::vector<int> heights;
+    for (int i = 1; i < count; ++i) {
+        const int height = stats.at<int>(i, cv::CC_STAT_HEIGHT);
+        const int area = stats.at<int>(i, cv::CC_STAT_AREA);
+        // Skip specks and anything taller than a line of text could be
+        if (height >= 3 && area >= 4 && height < mask.rows)
+            heights.push_back(height);
+    }
+    if (heights.empty())
+        return 0;
+
+    std::nth_element(heights.begin(), heights.begin() + heights.size() / 2, heights.end());
+    return heights[heights.size() / 2];
+}
+
+GrayImage run(const GrayImage &gray, const PreprocessOptions &options, int *dpi) {
+    *dpi = screenDpi;
+    if (gray.isNull() || (!options.crop && !options.binarize && options.glyphHeight <= 0))
+        return gray;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 last = 0;
+    auto lap = [&timer, &last]() {
+        const qint64 now = timer.nsecsElapsed();
+        const double ms = (now - last) / 1e6;
+        last = now;
+        return ms;
+    };
+    double maskMs = 0, cropMs = 0, scaleMs = 0, binarizeMs = 0;
+
+    cv::Mat image = wrap(gray);
+    bool darkText = true;
+    cv::Mat mask = foregroundMask(image, &darkText);
+    maskMs = lap();
+
+    if (options.crop) {
+        cv::Mat points;
+        cv::findNonZero(mask, points);
+        if (!points.empty()) {
+            // Keep a small quiet zone, tesseract misses glyphs touching the border
+            const int margin = 6;
+            cv::Rect box = cv::boundingRect(points);
+            box -= cv::Point(margin, margin);
+            box += cv::Size(2 * margin, 2 * margin);
+            box &= cv::Rect(0, 0, image.cols, image.rows);
+            image = image(box);
+            mask = mask(box);
+        }
+        cropMs = lap();
+    }
+
+    // The glyph height tells the resolution even when the scale is kept
+    const int glyphHeight = medianGlyphHeight(mask);
+    if (glyphHeight > 0) {
+        double scale = 1.0;
+        if (options.glyphHeight > 0) {
+            scale = std::clamp(double(options.glyphHeight) / glyphHeight, 0.5, 4.0);
+            if (scale > 1.0)
+                scale = std::max(1.0, std::min(scale, std::sqrt(maxScaledPixels / image.total())));
+
+            // Close enough already, resampling would only blur
+            if (qAbs(scale - 1.0) <= 0.15) {
+                scale = 1.0;
+            } else {
+                cv::Mat scaled;
+                cv::resize(image, scaled, cv::Size(), scale, scale, scale > 1.0 ? cv::INTER_CUBIC : cv::INTER_AREA);
+                image = scaled;
+            }
+        }
+        *dpi = qRound(referenceDpi * glyphHeight * scale / referenceGlyphHeight);
+    }
+    scaleMs = lap();
+
+    if (options.binarize) {
+        cv::Mat binary;
+        cv::adaptiveThreshold(image, binary, 255, cv::ADAPTIVE_THRESH_MEAN_C,
+                              darkText ? cv::THRESH_BINARY : cv::THRESH_BINARY_INV, 31, 10);
+        image = binary;
+        binarizeMs = lap();
+    }
+
+    GrayImage processed = unwrap(image);
+
+    qCInfo(lcTiming).nospace() << "preprocess " << gray.width << "x" << gray.height << " -> "
+                               << processed.width << "x" << processed.height << " at " << *dpi << " dpi: mask "
+                               << maskMs << " ms, crop " << cropMs << " ms, scale " << scaleMs
+                               << " ms, binarize " << binarizeMs << " ms, total " << timer.nsecsElapsed() / 1e6 << " ms";
+    return processed;
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <QString>
+
+#include "imageconvert.h"
+
+// Steps run on the gray selection before it is handed to tesseract
+struct PreprocessOptions
+{
+    // Trim empty margins down to the bounding box of the text
+    bool crop = true;
+    // Adaptive threshold to dark text on a white background
+    bool binarize = false;
+    // Rescale so the median connected component is this many pixels high,
+    // 0 keeps the scale
+    int glyphHeight = 22;
+
+    static PreprocessOptions fromString(const QString &steps, int glyphHeight);
+    QString toString() const;
+};
+
+namespace preprocess {
+
+// Resolution tesseract is told about when nothing better is known
+const int screenDpi = 96;
+
+// Returns the processed copy of gray and the resolution to pass to
+// SetSourceResolution() for it
+GrayImage run(const GrayImage &gray, const PreprocessOptions &options, int *dpi);
+
+}
+
+#endif // PREPROCESS_H
@@ -0,0 +1,147 @@
+#include "recognizer.h"
+#include "timing.h"
+#include "preprocess.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+
+#include <leptonica/allheaders.h>
+#include <tesseract/ocrclass.h>
+
+#include <memory>
+
+Recognizer::Recognizer(EnginePool *engines)
+    : engines(engines)
+{
+}
+
+// Polled by tesseract through ETEXT_DESC while it recognizes words
+static bool isCancelled(void *cancel, int) {
+    return static_cast<std::atomic_bool *>(cancel)->load();
+}
+
+QString Recognizer::recognize(const QImage &image, std::atomic_bool *cancel) {
+    // Grayscale straight from the 32-bit image buffer
+    GrayImage gray;
+    {
+        TraceScope stage("toGray");
+        gray = imageconvert::toGray(image);
+    }
+    if (gray.isNull())
+        return QString();
+
+    QString text;
+    ResultCache::Key key;
+    if (cache) {
+        TraceScope stage("cache");
+        key = cache->key(gray, cacheConfig());
+        if (cancel ? cache->peek(key, &text) : cache->lookup(key, &text))
+            return text;
+    }
+
+    text = recognizeGray(gray, cancel);
+    if (cache && !cancel && !text.isEmpty())
+        cache->insert(key, text);
+    return text;
+}
+
+void Recognizer::remember(const QImage &image, const QString &text) {
+    if (!cache)
+        return;
+
+    const GrayImage gray = imageconvert::toGray(image);
+    if (gray.isNull())
+        return;
+
+    const ResultCache::Key key = cache->key(gray, cacheConfig());
+    QString cached;
+    if (!cache->lookup(key, &cached) && !text.isEmpty())
+        cache->insert(key, text);
+}
+
+// Everything that changes the text for the same pixels goes into the key
+QString Recognizer::cacheConfig() const {
+    return engines->languages() + '|' + preprocessing.toString();
+}
+
+QString Recognizer::recognizeGray(const GrayImage &source, std::atomic_bool *cancel) {
+    // Trim and normalize before tesseract spends time on the pixels
+    int dpi;
+    GrayImage gray;
+    {
+        TraceScope stage("preprocess");
+        gray = preprocess::run(source, preprocessing, &dpi);
+    }
+    const QRect whole(0, 0, gray.width, gray.height);
+
+    // Small selections or a single engine gain nothing from splitting
+    if (splitArea <= 0 || engines->size() < 2 || gray.width * gray.height < splitArea)
+        return recognizeRect(gray, whole, dpi, cancel);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QList<QRect> blocks = textBlocks(gray, dpi);
+    if (cancel && *cancel)
+        return QString();
+    if (blocks.size() < 2)
+        return recognizeRect(gray, whole, dpi, cancel);
+
+    // Blocks come back in reading order and blockingMapped keeps that order
+    const QStringList texts = QtConcurrent::blockingMapped<QStringList>(blocks, [this, &gray, dpi, cancel](const QRect &block) {
+        return recognizeRect(gray, block, dpi, cancel);
+    });
+    if (cancel && *cancel)
+        return QString();
+
+    qCInfo(lcTiming) << "split" << whole.size() << "into" << blocks.size() << "blocks, recognized in" << timer.elapsed() << "ms";
+    return texts.join(QString());
+}
+
+// Runs tesseract's layout analysis only and returns the text blocks
+QList<QRect> Recognizer::textBlocks(const GrayImage &gray, int dpi) {
+    EngineLease tess(engines);
+    tess->SetImage(gray.bits(), gray.width, gray.height, 1, gray.stride);
+    tess->SetSourceResolution(dpi);
+
+    TraceScope stage("layout");
+    QList<QRect> blocks;
+    Boxa *boxes = tess->GetComponentImages(tesseract::RIL_BLOCK, true, nullptr, nullptr);
+    if (!boxes)
+        return blocks;
+
+    for (int i = 0; i < boxaGetCount(boxes); ++i) {
+        l_int32 x, y, w, h;
+        if (boxaGetBoxGeometry(boxes, i, &x, &y, &w, &h) == 0)
+            blocks.append(QRect(x, y, w, h));
+    }
+    boxaDestroy(&boxes);
+    return blocks;
+}
+
+QString Recognizer::recognizeRect(const GrayImage &gray, const QRect &rect, int dpi, std::atomic_bool *cancel) {
+    // Borrow an already initialized engine from the pool
+    EngineLease tess(engines);
+
+    // Only the rectangle is handed over, tesseract copies it from the shared buffer
+    const uchar *origin = gray.bits() + size_t(rect.y()) * gray.stride + rect.x();
+    tess->SetImage(origin, rect.width(), rect.height(), 1, gray.stride);
+
+    // Known from the glyph sizes, so tesseract does not have to guess it
+    tess->SetSourceResolution(dpi);
+
+    // Perform OCR
+    ETEXT_DESC monitor;
+    monitor.cancel = &isCancelled;
+    monitor.cancel_this = cancel;
+    {
+        TraceScope stage("Recognize");
+        if (tess->Recognize(cancel ? &monitor : nullptr) != 0 || (cancel && *cancel))
+            return QString();
+    }
+
+    TraceScope stage("GetUTF8Text");
+    std::unique_ptr<char[]> outText(tess->GetUTF8Text());
+    return QString::fromUtf8(outText.get());
+}
@@ -0,0 +1,55 @@
+#ifndef RECOGNIZER_H
+#define RECOGNIZER_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QString>
+
+#include <atomic>
+
+#include "enginepool.h"
+#include "imageconvert.h"
+#include "resultcache.h"
+#include "preprocess.h"
+
+// The recognition pipeline shared by the overlay and the batch mode,
+// it does not touch any widgets and is safe to call from several threads
+class Recognizer
+{
+public:
+    explicit Recognizer(EnginePool *engines);
+
+    // Setting *cancel stops the recognition early and an empty string is returned.
+    // Cancellable runs are speculative, they read the cache without counting
+    // in its statistics and never fill it.
+    QString recognize(const QImage &image, std::atomic_bool *cancel = nullptr);
+
+    // Accounts for a released selection whose text came from a speculative run,
+    // it counts as one cache hit or miss and a new text is stored
+    void remember(const QImage &image, const QString &text);
+
+    // Selections of at least this many pixels are split into text blocks that
+    // are recognized concurrently, 0 turns splitting off
+    void setSplitArea(int pixels) { splitArea = pixels; }
+
+    static const int defaultSplitArea = 640 * 480;
+
+    void setPreprocessing(const PreprocessOptions &options) { preprocessing = options; }
+
+    // Results are looked up and stored by their gray pixels, nullptr disables caching
+    void setCache(ResultCache *cache) { this->cache = cache; }
+
+private:
+    EnginePool *engines;
+    int splitArea = defaultSplitArea;
+    ResultCache *cache = nullptr;
+    PreprocessOptions preprocessing;
+
+    QString cacheConfig() const;
+    QString recognizeGray(const GrayImage &source, std::atomic_bool *cancel);
+    QList<QRect> textBlocks(const GrayImage &gray, int dpi);
+    QString recognizeRect(const GrayImage &gray, const QRect &rect, int dpi, std::atomic_bool *cancel);
+};
+
+#endif // RECOGNIZER_H
@@ -0,0 +1,290 @@
+#include "resultcache.h"
+#include "timing.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+
+#include <cstring>
+#include <vector>
+
+static const quint32 storeMagic = 0x54524332; // "TRC2"
+static const QDataStream::Version storeVersion = QDataStream::Qt_6_0;
+
+// Perceptual matches may differ in this many of the 256 gradient bits
+static const int maxPerceptualDistance = 6;
+
+// Finalizer of MurmurHash3, spreads every input bit over the whole word
+static inline quint64 mix(quint64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Word-at-a-time hash, fast enough to run over a full-screen selection and
+// stable across runs so keys can be stored on disk
+static quint64 hashBytes(const uchar *data, size_t length, quint64 seed) {
+    quint64 h = mix(seed ^ (length * 0x9e3779b97f4a7c15ULL));
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        quint64 word;
+        memcpy(&word, data + i, 8);
+        h ^= word * 0x87c37b91114253d5ULL;
+        h = ((h << 31) | (h >> 33)) * 0x4cf5ad432745937fULL;
+    }
+    quint64 tail = 0;
+    memcpy(&tail, data + i, length - i);
+    return mix(h ^ tail);
+}
+
+static quint64 hashConfig(const QString &config) {
+    const QByteArray bytes = config.toUtf8();
+    return hashBytes(reinterpret_cast<const uchar *>(bytes.constData()), bytes.size(), 0);
+}
+
+static quint64 exactKey(const GrayImage &gray, quint64 config) {
+    quint64 seed = mix(config ^ (quint64(gray.width) << 32 | quint32(gray.height)));
+    for (int y = 0; y < gray.height; ++y)
+        seed = hashBytes(gray.bits() + size_t(y) * gray.stride, gray.width, seed);
+    return seed;
+}
+
+// Difference hash: the image is averaged down to 17x16 cells and every bit
+// tells whether a cell is brighter than its right neighbour. Small shifts,
+// scaling and antialiasing changes leave most bits alone.
+static std::array<quint64, 4> perceptualHash(const GrayImage &gray) {
+    const int columns = 17;
+    const int rows = 16;
+    quint64 sums[rows][columns] = {};
+    quint32 counts[rows][columns] = {};
+
+    std::vector<int> cellOf(gray.width);
+    for (int x = 0; x < gray.width; ++x)
+        cellOf[x] = x * columns / gray.width;
+
+    for (int y = 0; y < gray.height; ++y) {
+        const int cy = y * rows / gray.height;
+        const uchar *line = gray.bits() + size_t(y) * gray.stride;
+        for (int x = 0; x < gray.width; ++x) {
+            sums[cy][cellOf[x]] += line[x];
+            ++counts[cy][cellOf[x]];
+        }
+    }
+
+    std::array<quint64, 4> hash = {};
+    for (int cy = 0; cy < rows; ++cy) {
+        for (int cx = 0; cx < columns - 1; ++cx) {
+            // Compare averages without dividing, empty cells count as black
+            const quint64 left = sums[cy][cx] * qMax(1u, counts[cy][cx + 1]);
+            const quint64 right = sums[cy][cx + 1] * qMax(1u, counts[cy][cx]);
+            if (left > right) {
+                const int bit = cy * (columns - 1) + cx;
+                hash[bit / 64] |= quint64(1) << (bit % 64);
+            }
+        }
+    }
+    return hash;
+}
+
+static int distance(const std::array<quint64, 4> &a, const std::array<quint64, 4> &b) {
+    int bits = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        bits += qPopulationCount(a[i] ^ b[i]);
+    return bits;
+}
+
+ResultCache::ResultCache(const QString &path, int maxEntries, Mode mode)
+    : path(path)
+    , maxEntries(qMax(1, maxEntries))
+    , mode(mode)
+{
+}
+
+ResultCache::~ResultCache()
+{
+    save();
+}
+
+QString ResultCache::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results.cache";
+}
+
+ResultCache::Key ResultCache::key(const GrayImage &gray, const QString &config) const {
+    Key key;
+    key.config = hashConfig(config);
+    key.exact = exactKey(gray, key.config);
+    // Exact mode never compares gradients, so skip the extra pass over the pixels
+    key.perceptual = mode == Perceptual;
+    key.phash = key.perceptual ? perceptualHash(gray) : PerceptualHash();
+    key.width = gray.width;
+    key.height = gray.height;
+    return key;
+}
+
+std::list<ResultCache::Entry>::iterator ResultCache::find(const Key &key) {
+    auto it = index.value(key.exact, entries.end());
+    if (it == entries.end() && mode == Perceptual)
+        it = findSimilar(key);
+    return it;
+}
+
+bool ResultCache::lookup(const Key &key, QString *text) {
+    QMutexLocker locker(&mutex);
+    const auto it = find(key);
+    if (it == entries.end()) {
+        ++misses;
+        qCDebug(lcTiming) << "cache miss," << hits << "hits" << misses << "misses";
+        return false;
+    }
+
+    // Move to the front, it is now the most recently used entry
+    entries.splice(entries.begin(), entries, it);
+    *text = it->text;
+    ++hits;
+    dirty = true;
+    qCInfo(lcTiming) << "cache hit," << hits << "hits" << misses << "misses";
+    return true;
+}
+
+bool ResultCache::peek(const Key &key, QString *text) {
+    QMutexLocker locker(&mutex);
+    const auto it = find(key);
+    if (it == entries.end())
+        return false;
+    *text = it->text;
+    return true;
+}
+
+// Linear scan, the cache is small next to the cost of one recognition
+std::list<ResultCache::Entry>::iterator ResultCache::findSimilar(const Key &key) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        const Key &other = it->key;
+        if (other.config != key.config || !other.perceptual)
+            continue;
+        // Only selections of about the same size can hold the same text
+        if (qAbs(other.width - key.width) > qMax(2, key.width / 50)
+                || qAbs(other.height - key.height) > qMax(2, key.height / 50))
+            continue;
+        if (distance(other.phash, key.phash) <= maxPerceptualDistance)
+            return it;
+    }
+    return entries.end();
+}
+
+void ResultCache::insert(const Key &key, const QString &text) {
+    QMutexLocker locker(&mutex);
+    if (index.contains(key.exact))
+        return;
+
+    entries.push_front(Entry{key, text});
+    index.insert(key.exact, entries.begin());
+    evict();
+    dirty = true;
+}
+
+void ResultCache::evict() {
+    while (int(entries.size()) > maxEntries) {
+        index.remove(entries.back().key.exact);
+        entries.pop_back();
+    }
+}
+
+bool ResultCache::load() {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(storeVersion);
+    quint32 magic;
+    quint32 count;
+    in >> magic;
+    if (magic != storeMagic)
+        return false;
+    in >> hits >> misses >> count;
+
+    QMutexLocker locker(&mutex);
+    entries.clear();
+    index.clear();
+    for (quint32 i = 0; i < count; ++i) {
+        Entry entry;
+        Key &key = entry.key;
+        qint32 width, height;
+        in >> key.exact >> key.config >> key.perceptual;
+        for (quint64 &word : key.phash)
+            in >> word;
+        in >> width >> height >> entry.text;
+        // A truncated store must not leave a half read entry behind
+        if (in.status() != QDataStream::Ok)
+            break;
+        key.width = width;
+        key.height = height;
+
+        entries.push_back(entry);
+        index.insert(key.exact, std::prev(entries.end()));
+    }
+    evict();
+    return in.status() == QDataStream::Ok;
+}
+
+// Written most recently used first, so loading keeps the eviction order
+bool ResultCache::save() {
+    QMutexLocker saveLocker(&saveMutex);
+
+    std::list<Entry> snapshot;
+    quint64 savedHits, savedMisses;
+    {
+        QMutexLocker locker(&mutex);
+        if (!dirty)
+            return true;
+        snapshot = entries;
+        savedHits = hits;
+        savedMisses = misses;
+        dirty = false;
+    }
+
+    // Anything that changed meanwhile is written by the next save
+    auto failed = [this]() {
+        QMutexLocker locker(&mutex);
+        dirty = true;
+        return false;
+    };
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return failed();
+
+    QDataStream out(&file);
+    out.setVersion(storeVersion);
+    out << storeMagic << savedHits << savedMisses << quint32(snapshot.size());
+    for (const Entry &entry : snapshot) {
+        const Key &key = entry.key;
+        out << key.exact << key.config << key.perceptual;
+        for (quint64 word : key.phash)
+            out << word;
+        out << qint32(key.width) << qint32(key.height) << entry.text;
+    }
+
+    if (!file.commit())
+        return failed();
+    return true;
+}
+
+QString ResultCache::stats() {
+    QMutexLocker locker(&mutex);
+    const quint64 lookups = hits + misses;
+    return QString("%1 entries (limit %2), %3 hits, %4 misses, %5% hit rate")
+        .arg(entries.size())
+        .arg(maxEntries)
+        .arg(hits)
+        .arg(misses)
+        .arg(lookups ? 100.0 * hits / lookups : 0.0, 0, 'f', 1);
+}
@@ -0,0 +1,78 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <array>
+#include <list>
+
+#include "imageconvert.h"
+
+// Remembers recognized text by the gray pixels it came from, so the same
+// region on screen is only recognized once. Entries are evicted least
+// recently used first and kept on disk between runs.
+class ResultCache
+{
+public:
+    enum Mode { Exact, Perceptual };
+
+    typedef std::array<quint64, 4> PerceptualHash;
+
+    // Identifies the pixels of a selection, computed once and shared by lookup and insert
+    struct Key
+    {
+        quint64 exact;
+        quint64 config;
+        bool perceptual; // phash is only computed in Perceptual mode
+        PerceptualHash phash;
+        int width;
+        int height;
+    };
+
+    ResultCache(const QString &path, int maxEntries, Mode mode);
+    ~ResultCache();
+
+    Key key(const GrayImage &gray, const QString &config) const;
+    // Counts a hit or miss and marks the entry as recently used
+    bool lookup(const Key &key, QString *text);
+    // Same match without touching the statistics or the eviction order, for speculative runs
+    bool peek(const Key &key, QString *text);
+    void insert(const Key &key, const QString &text);
+
+    bool load();
+    // Safe to call from a worker, lookups only wait while the entries are copied
+    bool save();
+
+    QString stats();
+
+    static QString defaultPath();
+
+private:
+    struct Entry
+    {
+        Key key;
+        QString text;
+    };
+
+    QString path;
+    int maxEntries;
+    Mode mode;
+    bool dirty = false;
+
+    // Most recently used first
+    std::list<Entry> entries;
+    QHash<quint64, std::list<Entry>::iterator> index;
+    quint64 hits = 0;
+    quint64 misses = 0;
+    QMutex mutex;
+    // Keeps two saves from writing the file at the same time
+    QMutex saveMutex;
+
+    std::list<Entry>::iterator find(const Key &key);
+    std::list<Entry>::iterator findSimilar(const Key &key);
+    void evict();
+};
+
+#endif // RESULTCACHE_H
@@ -1,99 +1,206 @@
 #include "textrec.h"
 #include "ui_textrec.h"
+#include "timing.h"
+#include "trace.h"
 
-textrec::textrec(QWidget *parent)
+#include <QtConcurrent/QtConcurrent>
+
+// How long the selection has to stay still before recognition starts
+static const int speculationDelay = 150;
+
+// Smaller selections, like a plain click, hold no text worth recognizing
+static const int minSelectionSize = 4;
+
+// Pen width of the rubber band and the margin repainted around its edges
+static const int bandWidth = 2;
+
+// The area covered by the outline of rect, the inside is left alone
+static QRegion outline(const QRect &rect) {
+    const QRect outer = rect.adjusted(-bandWidth, -bandWidth, bandWidth, bandWidth);
+    const QRect inner = rect.adjusted(bandWidth, bandWidth, -bandWidth, -bandWidth);
+    return QRegion(outer).subtracted(QRegion(inner));
+}
+
+textrec::textrec(Recognizer *recognizer, QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::textrec)
+    , recognizer(recognizer)
 {
     ui->setupUi(this);
 
-    // Screen shot
-    shootScreen();
-
     // Fine tunings to adjust window in the best borderless full window
     this->setWindowFlags(Qt::WindowStaysOnTopHint | Qt::X11BypassWindowManagerHint | Qt::FramelessWindowHint);
-    this->setAttribute(Qt::WA_TranslucentBackground);
-    this->move(-11, -11);
 
-    // label adjustments
-    label->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    label->setAlignment(Qt::AlignCenter);
+    // The screen shot covers the whole window, so Qt does not need to clear
+    // the background before every paint
+    this->setAttribute(Qt::WA_OpaquePaintEvent);
+    this->setAttribute(Qt::WA_NoSystemBackground);
+
+    setWindowFlags (Qt::Popup);
 
-    // To give tesseract drawless pixmap give copied pixmap as input to it
-    drawing_pixmap = pixmap.copy();
+    speculationTimer.setSingleShot(true);
+    speculationTimer.setInterval(speculationDelay);
+    connect(&speculationTimer, &QTimer::timeout, this, &textrec::speculate);
+}
 
-    // Set pixmap to label and label to layout
-    label->setPixmap(drawing_pixmap);
-    layout->addWidget(label);
-    setLayout(layout);
+// Takes a fresh screen shot and shows the overlay over it
+void textrec::capture() {
+    cancelSpeculation();
 
-    setWindowFlags (Qt::Popup);
+    // Screen shot
+    shootScreen();
+
+    // Nothing is drawn into the pixmap anymore, so sharing it is enough
+    drawing_pixmap = pixmap;
+    band = QRect();
+    selecting = false;
+
+    // The overlay shows the screen shot 1:1 over the screen it was taken from
+    if (QScreen *screen = QGuiApplication::primaryScreen())
+        setGeometry(screen->geometry());
+
+    show();
+    activateWindow();
 }
 
-// Get mouse starting point (-10 to reduce mouse size)
+// Get mouse starting point
 void textrec::mousePressEvent(QMouseEvent *event) {
-    start_x = event->pos().x() - 10;
-    start_y = event->pos().y() - 10;
+    start_x = event->pos().x();
+    start_y = event->pos().y();
+    x_pos = start_x;
+    y_pos = start_y;
+
+    // Clear the band of a previous selection
+    update(outline(band));
+    band = QRect();
+    selecting = true;
+    frameStats = FrameStats();
 }
 
-// Get mouse current point (-10 to reduce mouse size)
+// Get mouse current point
 void textrec::mouseMoveEvent(QMouseEvent *event) {
-    x_pos = event->pos().x() - 10;
-    y_pos = event->pos().y() - 10;
+    x_pos = event->pos().x();
+    y_pos = event->pos().y();
     drawRectangle();
+
+    // A job for another rectangle is stale, stop it now so it frees its engines
+    if (speculation.result.isValid() && selectionRect() != speculation.rect)
+        cancelSpeculation();
+
+    // Restart the debounce, recognition starts once the rectangle is stable
+    speculationTimer.start();
 }
 
 void textrec::mouseReleaseEvent(QMouseEvent *event) {
-    int rect_width = x_pos - start_x;
-    int rect_height = y_pos - start_y;
+    speculationTimer.stop();
+    selecting = false;
+    reportFrameStats();
 
+    // give the selected area as input to tesseract function
+    const QString text = rec(selectionRect());
+
+    // Hide the window after the drawing and recognition process finish,
+    // whoever started the capture decides what happens next
+    if (event->button() == Qt::LeftButton) {
+        this->hide();
+        emit captureFinished(text);
+    }
+}
+
+QRect textrec::selectionRect() const {
     // Handles x and y positions to handle the situation that mouse is going to backward
     // in x axis or y axis otherwise the cropping process crops the pixmap in a wierd way
-    if (rect_width < 0) {
-        rect_width = start_x - x_pos;
-        start_x = x_pos;
-    }
+    return QRect(qMin(start_x, x_pos), qMin(start_y, y_pos),
+                 qAbs(x_pos - start_x), qAbs(y_pos - start_y));
+}
 
-    if (rect_height < 0) {
-        rect_height = start_y - y_pos;
-        start_y = y_pos;
-    }
+// Recognizes the current rectangle off the GUI thread while the mouse is still down
+void textrec::speculate() {
+    const QRect rect = selectionRect();
+    if (rect == speculation.rect || rect.width() < minSelectionSize || rect.height() < minSelectionSize)
+        return;
 
-    // crops the pixmap
-    QRect rect(start_x, start_y, rect_width, rect_height);
-    QPixmap cropped = drawing_pixmap.copy(rect);
+    cancelSpeculation();
 
-    // give cropped image as input to tesseract function
-    rec(cropped);
+    // QPixmap may only be used on the GUI thread, the worker gets a QImage
+    const QImage image = selectionImage(rect);
+    std::shared_ptr<std::atomic_bool> cancel = std::make_shared<std::atomic_bool>(false);
+    Recognizer *recognizer = this->recognizer;
 
-    // Close the window after the drawing and recognition process finish
-    if (event->button() == Qt::LeftButton) {
-        this->close();
-    }
+    speculation.rect = rect;
+    speculation.image = image;
+    speculation.cancel = cancel;
+    speculation.result = QtConcurrent::run([recognizer, image, cancel]() {
+        return recognizer->recognize(image, cancel.get());
+    });
+}
+
+// Stops a stale job, tesseract notices the flag through its progress monitor
+void textrec::cancelSpeculation() {
+    if (speculation.cancel)
+        *speculation.cancel = true;
+    speculation = Speculation();
 }
 
 // Starts to paint
 void textrec::paintEvent(QPaintEvent *event) {
-    QWidget::paintEvent(event);
+    QElapsedTimer timer;
+    const bool timed = lcTiming().isInfoEnabled();
+    if (timed)
+        timer.start();
+
+    // Blit only the dirty rectangles of the static screen shot, the source
+    // rectangle is in device pixels of the grab
     QPainter painter(this);
-    painter.drawPixmap(0, 0, drawing_pixmap);
+    const qreal dpr = drawing_pixmap.devicePixelRatio();
+    for (const QRect &rect : event->region())
+        painter.drawPixmap(rect, drawing_pixmap, QRectF(QPointF(rect.topLeft()) * dpr, QSizeF(rect.size()) * dpr));
+
+    if (selecting && event->region().intersects(outline(band))) {
+        QPen pen;
+        pen.setWidth(bandWidth);
+        pen.setColor(Qt::green);
+        painter.setPen(pen);
+        painter.drawRect(band);
+    }
+
+    if (timed && pendingFrame.isValid()) {
+        const qint64 paintNs = timer.nsecsElapsed();
+        const qint64 latencyNs = pendingFrame.nsecsElapsed();
+        pendingFrame.invalidate();
+
+        ++frameStats.frames;
+        frameStats.paintNs += paintNs;
+        frameStats.maxPaintNs = qMax(frameStats.maxPaintNs, paintNs);
+        frameStats.latencyNs += latencyNs;
+        frameStats.maxLatencyNs = qMax(frameStats.maxLatencyNs, latencyNs);
+    }
 }
 
+// Invalidates the old and the new outline of the rubber band, everything
+// else on screen stays as it is
 void textrec::drawRectangle() {
-    // Create a temporary pixmap to draw the rectangle
-    QPixmap temp_pixmap = drawing_pixmap;
-    QPainter painter(&temp_pixmap);
+    const QRect next = selectionRect();
+    if (next == band)
+        return;
 
-    QPen pen;
-    pen.setWidth(2);
-    pen.setColor(Qt::green);
-    painter.setPen(pen);
+    // Moves that arrive before the next paint are merged into one frame
+    if (!pendingFrame.isValid())
+        pendingFrame.start();
 
-    painter.drawRect(start_x, start_y, x_pos - start_x, y_pos - start_y);
+    update(outline(band) + outline(next));
+    band = next;
+}
+
+void textrec::reportFrameStats() {
+    if (!frameStats.frames)
+        return;
 
-    // Update the label with the temporary pixmap
-    label->setPixmap(temp_pixmap);
-    label->update(); // Ensure the label is updated
+    const int frames = frameStats.frames;
+    qCInfo(lcTiming).nospace() << "overlay: " << frames << " frames, paint avg "
+                               << frameStats.paintNs / frames / 1e6 << " ms max " << frameStats.maxPaintNs / 1e6
+                               << " ms, move to paint avg " << frameStats.latencyNs / frames / 1e6
+                               << " ms max " << frameStats.maxLatencyNs / 1e6 << " ms";
 }
 
 void textrec::shootScreen() {
@@ -103,83 +210,91 @@ void textrec::shootScreen() {
     if (!screen)
         return;
 
+    TraceScope stage("capture");
     pixmap = screen->grabWindow(0);
 }
 
-void textrec::rec(const QPixmap &pixmap) {
-    QImage qImage = pixmap.toImage();
-
-    // Convert QImage to cv::Mat
-    cv::Mat mat(qImage.height(), qImage.width(), CV_8UC4, const_cast<uchar*>(qImage.bits()), qImage.bytesPerLine());
-    cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR); // Convert from BGRA to BGR
-
-    // Initialize Tesseract OCR
-    tesseract::TessBaseAPI tess;
-    tess.Init(NULL, "eng"); // Specify language ("eng" for English)
+// The part of the screen shot under rect, which is in widget coordinates
+// while the grab has device pixels
+QImage textrec::selectionImage(const QRect &rect) const {
+    TraceScope stage("toImage");
+    const qreal dpr = drawing_pixmap.devicePixelRatio();
+    return drawing_pixmap.copy(QRectF(QPointF(rect.topLeft()) * dpr, QSizeF(rect.size()) * dpr).toAlignedRect()).toImage();
+}
 
-    // Read the image using OpenCV
-    // cv::Mat cvImage = cv::imread("/home/pardusumsu/code/textrec/test-imgs/yamuq.png", cv::IMREAD_COLOR);
-    cv::Mat cvImage = mat;
-    if (cvImage.empty()) {
-        std::cerr << "Error: Unable to open image file!" << std::endl;
+QString textrec::rec(const QRect &rect) {
+    // copy() of an empty rectangle would send the whole screen to recognition
+    if (rect.width() < minSelectionSize || rect.height() < minSelectionSize) {
+        cancelSpeculation();
+        return QString();
     }
 
-    // Convert OpenCV image to Leptonica's Pix format
-    Pix *image = pixCreate(cvImage.size().width, cvImage.size().height, 8);
-    for (int y = 0; y < cvImage.rows; ++y) {
-        for (int x = 0; x < cvImage.cols; ++x) {
-            cv::Vec3b color = cvImage.at<cv::Vec3b>(cv::Point(x, y));
-            int val = (color[0] + color[1] + color[2]) / 3; // Convert to grayscale
-            pixSetPixel(image, x, y, val);
-        }
+    QElapsedTimer timer;
+    timer.start();
+
+    // Use the speculative result if it was started on the same rectangle,
+    // waiting for it if it is still running
+    QString text;
+    QImage speculativeImage;
+    const bool hit = speculation.result.isValid() && speculation.rect == rect;
+    if (hit) {
+        text = speculation.result.result();
+        speculativeImage = speculation.image;
+        speculation = Speculation();
+    } else {
+        cancelSpeculation();
+        text = recognizer->recognize(selectionImage(rect));
     }
 
-    // Set the image to Tesseract
-    tess.SetImage(image);
+    if (text.isEmpty()) {
+        std::cerr << "Error: No text recognized in the selection!" << std::endl;
+        if (hit)
+            recognizer->remember(speculativeImage, text);
+        return text;
+    }
 
-    // Perform OCR
-    char* outText = tess.GetUTF8Text();
+    const qint64 recognizedNs = timer.nsecsElapsed();
+    deliver(text);
 
-    copyClipboard(outText);
-    sendNotification(outText);
+    qCInfo(lcTiming) << "release to clipboard:" << timer.elapsed() << "ms for" << rect.size()
+                     << (hit ? "(speculative)" : "(recognized after release)")
+                     << "of which delivery" << (timer.nsecsElapsed() - recognizedNs) / 1e6 << "ms";
 
-    // Clean up
-    delete[] outText;
-    pixDestroy(&image);
-    tess.End();
+    // Speculative runs leave the cache alone, the released selection is counted
+    // once and stored
+    if (hit)
+        recognizer->remember(speculativeImage, text);
+    return text;
 }
 
-// Copy the text to clipboard
-void textrec::copyClipboard(char* outText) {
-    const size_t len = strlen(outText);
-
-    // Open a pipe to the xclip command
-    FILE* pipe = popen("xclip -selection clipboard", "w");
-    if (!pipe) {
-        std::cerr << "Failed to open pipe to xclip" << std::endl;
-    }
-
-    // Write the output to the pipe
-    fwrite(outText, sizeof(char), len, pipe);
-
-    // Close the pipe
-    pclose(pipe);
+void textrec::addSink(OutputSink *sink) {
+    sinks.emplace_back(sink);
 }
 
-// Send an notification to user to inform him about recognized text
-void textrec::sendNotification(char* outText) {
-    std::string notify = "notify-send 'The recognized text copied to clipboard' '";
-    std::string command = notify + outText + "' -t 5000";
-    system(command.c_str());
+// Hands the text to every sink, none of them waits for another process
+void textrec::deliver(const QString &text) {
+    for (const std::unique_ptr<OutputSink> &sink : sinks) {
+        QElapsedTimer timer;
+        timer.start();
+        TraceScope stage(sink->name());
+        sink->deliver(text);
+        qCInfo(lcTiming) << sink->name() << "sink:" << timer.nsecsElapsed() / 1e6 << "ms";
+    }
 }
 
 void textrec::keyPressEvent(QKeyEvent *event) {
     if (event->key() == Qt::Key_Escape) {
-        QCoreApplication::exit();
+        cancelSpeculation();
+        this->hide();
+        emit captureFinished(QString());
     }
 }
 
 textrec::~textrec()
 {
+    // Workers, cancelled ones included, must not outlive the recognizer they use
+    cancelSpeculation();
+    QThreadPool::globalInstance()->waitForDone();
+
     delete ui;
 }
@@ -11,8 +11,6 @@
 
 #include <QScreen>
 #include <QWindow>
-#include <qlabel.h>
-#include <QVBoxLayout>
 #include <qsize.h>
 #include <QApplication>
 #include <QDebug>
@@ -21,6 +19,16 @@
 #include <QPaintEvent>
 #include <QPen>
 #include <QKeyEvent>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFuture>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "recognizer.h"
+#include "outputsink.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -33,9 +41,14 @@ class textrec : public QWidget
     Q_OBJECT
 
 public:
-    textrec(QWidget *parent = nullptr);
+    textrec(Recognizer *recognizer, QWidget *parent = nullptr);
     ~textrec();
 
+    void capture();
+
+    // Takes ownership, recognized text is handed to every sink in order
+    void addSink(OutputSink *sink);
+
     int start_x;
     int start_y;
     int x_pos;
@@ -43,17 +56,55 @@ public:
     int rect_width;
     int rect_height;
 
+signals:
+    // Emitted when the overlay is hidden, text is empty if nothing was recognized
+    void captureFinished(const QString &text);
+
 private:
     Ui::textrec *ui;
+    Recognizer *recognizer;
 
     QPixmap pixmap;
     QPixmap drawing_pixmap;
-    QLabel *label = new QLabel();
-    QVBoxLayout *layout = new QVBoxLayout();
+
+    // Rubber band currently on screen, only its outline is repainted
+    QRect band;
+    bool selecting = false;
+
+    // Frame times while dragging, collected only when textrec.timing is on
+    struct FrameStats
+    {
+        int frames = 0;
+        qint64 paintNs = 0;
+        qint64 maxPaintNs = 0;
+        qint64 latencyNs = 0;
+        qint64 maxLatencyNs = 0;
+    };
+    FrameStats frameStats;
+    QElapsedTimer pendingFrame;
     QSize screenSize = QApplication::primaryScreen()->size();
     QQuickView view;
 
-    void rec(const QPixmap &pixmap);
+    // Recognition started while the selection is still being dragged
+    struct Speculation
+    {
+        QRect rect;
+        QImage image;
+        QFuture<QString> result;
+        std::shared_ptr<std::atomic_bool> cancel;
+    };
+    Speculation speculation;
+    QTimer speculationTimer;
+
+    QRect selectionRect() const;
+    QImage selectionImage(const QRect &rect) const;
+    void speculate();
+    void cancelSpeculation();
+
+    std::vector<std::unique_ptr<OutputSink>> sinks;
+
+    QString rec(const QRect &rect);
+    void deliver(const QString &text);
     void shootScreen();
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
@@ -61,8 +112,6 @@ private:
     void keyPressEvent(QKeyEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
     void drawRectangle();
-
-    void copyClipboard(char* outText);
-    void sendNotification(char* outText);
+    void reportFrameStats();
 };
 #endif // TEXTREC_H
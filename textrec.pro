@@ -9,11 +9,31 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    batch.cpp \
+    daemon.cpp \
+    enginepool.cpp \
+    imageconvert.cpp \
     main.cpp \
-    textrec.cpp
+    outputsink.cpp \
+    preprocess.cpp \
+    recognizer.cpp \
+    resultcache.cpp \
+    textrec.cpp \
+    timing.cpp \
+    trace.cpp
 
 HEADERS += \
-    textrec.h
+    batch.h \
+    daemon.h \
+    enginepool.h \
+    imageconvert.h \
+    outputsink.h \
+    preprocess.h \
+    recognizer.h \
+    resultcache.h \
+    textrec.h \
+    timing.h \
+    trace.h
 
 FORMS += \
     textrec.ui
@@ -21,7 +41,10 @@ FORMS += \
 QT += gui \
       widgets \
       core gui \
-      quick
+      quick \
+      network \
+      concurrent \
+      dbus
 
 INCLUDEPATH += /usr/include/tesseract
 INCLUDEPATH += /usr/include/leptonica
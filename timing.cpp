@@ -0,0 +1,3 @@
+#include "timing.h"
+
+Q_LOGGING_CATEGORY(lcTiming, "textrec.timing", QtWarningMsg)
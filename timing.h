@@ -0,0 +1,9 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <QLoggingCategory>
+
+// Latency reports, enable with QT_LOGGING_RULES="textrec.timing=true"
+Q_DECLARE_LOGGING_CATEGORY(lcTiming)
+
+#endif // TIMING_H
@@ -0,0 +1,104 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+
+#include <atomic>
+
+namespace trace {
+
+static std::atomic_bool active = false;
+static std::atomic_int nextThreadId = 1;
+
+static QMutex mutex;
+static QFile *output = nullptr;
+static bool collecting = false;
+static QHash<QString, QList<qint64>> durations;
+
+static QElapsedTimer &epoch() {
+    static QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer;
+}
+
+// Small stable numbers read better in trace viewers than native thread ids
+static int threadId() {
+    thread_local const int id = nextThreadId++;
+    return id;
+}
+
+static void updateActive() {
+    active = output || collecting;
+}
+
+bool open(const QString &path) {
+    QMutexLocker locker(&mutex);
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        delete file;
+        return false;
+    }
+
+    // The closing bracket is optional in the array format
+    file->write("[\n");
+    file->flush();
+    delete output;
+    output = file;
+    epoch();
+    updateActive();
+    return true;
+}
+
+void close() {
+    QMutexLocker locker(&mutex);
+    delete output;
+    output = nullptr;
+    updateActive();
+}
+
+void setCollecting(bool enabled) {
+    QMutexLocker locker(&mutex);
+    collecting = enabled;
+    epoch();
+    updateActive();
+}
+
+QHash<QString, QList<qint64>> collected() {
+    QMutexLocker locker(&mutex);
+    QHash<QString, QList<qint64>> result;
+    result.swap(durations);
+    return result;
+}
+
+bool enabled() {
+    return active.load(std::memory_order_relaxed);
+}
+
+qint64 now() {
+    return epoch().nsecsElapsed();
+}
+
+void record(const char *stage, qint64 startNs, qint64 durationNs) {
+    const int tid = threadId();
+
+    QMutexLocker locker(&mutex);
+    if (collecting)
+        durations[QLatin1String(stage)].append(durationNs);
+
+    if (output) {
+        const QByteArray event = QByteArray("{\"name\":\"") + stage
+            + "\",\"ph\":\"X\",\"pid\":" + QByteArray::number(QCoreApplication::applicationPid())
+            + ",\"tid\":" + QByteArray::number(tid)
+            + ",\"ts\":" + QByteArray::number(startNs / 1000.0, 'f', 3)
+            + ",\"dur\":" + QByteArray::number(durationNs / 1000.0, 'f', 3) + "},\n";
+        output->write(event);
+        output->flush();
+    }
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <QtGlobal>
+
+// Per-stage timing of the recognition pipeline. Stages cost one relaxed
+// atomic load while tracing is off. When on, every stage is written as a
+// Chrome trace event (chrome://tracing, Perfetto) and/or collected in memory
+// for the benchmark.
+namespace trace {
+
+// Streams events to path as a Chrome trace JSON array, flushed as they come
+// so a killed daemon still leaves a readable trace
+bool open(const QString &path);
+void close();
+
+// Keeps the durations of every stage in memory until collected() is called
+void setCollecting(bool enabled);
+QHash<QString, QList<qint64>> collected();
+
+bool enabled();
+qint64 now();
+void record(const char *stage, qint64 startNs, qint64 durationNs);
+
+}
+
+// Times the enclosing scope as one stage, stage must be a string literal
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *stage) : stage(stage), start(trace::enabled() ? trace::now() : -1) {}
+    ~TraceScope() { if (start >= 0) trace::record(stage, start, trace::now() - start); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *stage;
+    qint64 start;
+};
+
+#endif // TRACE_H